@@ -36,6 +36,9 @@
 static int32_t oversample_scalefactor[] = {524288, 1572864, 3670016, 7864320,
                                            253952, 516096,  1040384, 2088960};
 
+// How often a reader retries if the producer keeps publishing under it
+static const uint8_t latest_retries = 4;
+
 /**************************************************************************/
 /*!
     @brief  Instantiates a new DPS310 class
@@ -256,7 +259,8 @@ bool Adafruit_DPS310::pressureAvailable(void) {
 /**************************************************************************/
 /*!
  * @brief Calculates the approximate altitude using barometric pressure and the
- * supplied sea level hPa as a reference.
+ * supplied sea level hPa as a reference. Reads the bus, so when a publisher
+ * is attached only the one producer task may call this.
  * @param seaLevelhPa
  *        The current hPa at sea level.
  * @return The approximate altitude above sea level in meters.
@@ -266,9 +270,9 @@ float Adafruit_DPS310::readAltitude(float seaLevelhPa) {
 
   float altitude;
 
-  _read();
+  dps310_sample_t sample = _read();
 
-  altitude = 44330 * (1.0 - pow((_pressure / 100) / seaLevelhPa, 0.1903));
+  altitude = 44330 * (1.0 - pow(sample.pressure / seaLevelhPa, 0.1903));
 
   return altitude;
 }
@@ -373,10 +377,12 @@ void Adafruit_DPS310::configureTemperature(dps310_rate_t rate,
 /*!
   @brief  Read the XYZ data from the sensor and store in the internal
   raw_pressure, raw_temperature, _pressure and _temperature variables.
+  The result is handed to the attached publisher and aggregator, if any.
+  @returns The compensated sample that was read
 */
 /**************************************************************************/
 
-void Adafruit_DPS310::_read(void) {
+dps310_sample_t Adafruit_DPS310::_read(void) {
   Adafruit_BusIO_Register PRS_B2 = Adafruit_BusIO_Register(
       i2c_dev, spi_dev, ADDRBIT8_HIGH_TOREAD, DPS310_PRSB2, 3, MSBFIRST);
   Adafruit_BusIO_Register TMP_B2 = Adafruit_BusIO_Register(
@@ -408,11 +414,27 @@ void Adafruit_DPS310::_read(void) {
            _pressure * ((int32_t)_c11 + _pressure * (int32_t)_c21));
 
   // Serial.print("Press: "); Serial.println(_pressure);
+
+  dps310_sample_t sample;
+  sample.temperature = _temperature;
+  sample.pressure = _pressure / 100;
+  sample.timestamp = millis();
+
+  if (_publisher != NULL) {
+    _publisher->publish(&sample);
+  }
+  if (_aggregator != NULL) {
+    _aggregator->addSample(&sample);
+  }
+
+  return sample;
 }
 
 /**************************************************************************/
 /*!
-    @brief  Gets the most recent sensor event, Adafruit Unified Sensor format
+    @brief  Gets the most recent sensor event, Adafruit Unified Sensor format.
+   Reads the bus, so when a publisher is attached only the one producer task
+   may call this, other tasks should use getLatestEvents() instead.
     @param  temp_event Pointer to an Adafruit Unified sensor_event_t object that
    we'll fill in with temperature data
     @param  pressure_event Pointer to an Adafruit Unified sensor_event_t object
@@ -422,8 +444,71 @@ void Adafruit_DPS310::_read(void) {
 /**************************************************************************/
 bool Adafruit_DPS310::getEvents(sensors_event_t *temp_event,
                                 sensors_event_t *pressure_event) {
-  _read();
+  dps310_sample_t sample = _read();
+  _fillEvents(&sample, temp_event, pressure_event);
+
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Gets the most recently published sample as Adafruit Unified
+   Sensor events, without touching the bus. Safe to call from any task.
+    @param  temp_event Pointer to an Adafruit Unified sensor_event_t object that
+   we'll fill in with temperature data
+    @param  pressure_event Pointer to an Adafruit Unified sensor_event_t object
+   that we'll fill in with pressure data
+    @returns True if a sample was available, false if no publisher is
+   attached or Adafruit_DPS310_Publisher::getLatestSample() failed
+*/
+/**************************************************************************/
+bool Adafruit_DPS310::getLatestEvents(sensors_event_t *temp_event,
+                                      sensors_event_t *pressure_event) {
+  dps310_sample_t sample;
+  if (_publisher == NULL || !_publisher->getLatestSample(&sample)) {
+    return false;
+  }
+  _fillEvents(&sample, temp_event, pressure_event);
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Attach a publisher that every sample read from the sensor is
+   handed to. From then on exactly one task (the producer) may call the
+   bus reading functions: getEvents(), readAltitude() and the getEvent() of
+   the Adafruit_Sensor objects. Every other task reads through the publisher
+   or getLatestEvents().
+    @param  publisher The publisher to feed, or NULL to detach
+*/
+/**************************************************************************/
+void Adafruit_DPS310::setPublisher(Adafruit_DPS310_Publisher *publisher) {
+  _publisher = publisher;
+}
 
+/**************************************************************************/
+/*!
+    @brief  Attach a statistics aggregator that is fed every sample read from
+   the sensor by the producer task. Its snapshotAndReset() may be called
+   from one other task, e.g. a telemetry uplink.
+    @param  aggregator The aggregator to feed, or NULL to detach
+*/
+/**************************************************************************/
+void Adafruit_DPS310::setAggregator(Adafruit_DPS310_Aggregator *aggregator) {
+  _aggregator = aggregator;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Fill in Adafruit Unified Sensor events from a sample
+    @param  sample The sample to convert
+    @param  temp_event Temperature event to fill in, may be NULL
+    @param  pressure_event Pressure event to fill in, may be NULL
+*/
+/**************************************************************************/
+void Adafruit_DPS310::_fillEvents(const dps310_sample_t *sample,
+                                  sensors_event_t *temp_event,
+                                  sensors_event_t *pressure_event) {
   if (temp_event != NULL) {
     /* Clear the event */
     memset(temp_event, 0, sizeof(sensors_event_t));
@@ -431,8 +516,8 @@ bool Adafruit_DPS310::getEvents(sensors_event_t *temp_event,
     temp_event->version = 1;
     temp_event->sensor_id = _sensorID;
     temp_event->type = SENSOR_TYPE_AMBIENT_TEMPERATURE;
-    temp_event->timestamp = millis();
-    temp_event->temperature = _temperature;
+    temp_event->timestamp = sample->timestamp;
+    temp_event->temperature = sample->temperature;
   }
 
   if (pressure_event != NULL) {
@@ -440,11 +525,9 @@ bool Adafruit_DPS310::getEvents(sensors_event_t *temp_event,
     pressure_event->version = 1;
     pressure_event->sensor_id = _sensorID;
     pressure_event->type = SENSOR_TYPE_PRESSURE;
-    pressure_event->timestamp = millis();
-    pressure_event->pressure = _pressure / 100;
+    pressure_event->timestamp = sample->timestamp;
+    pressure_event->pressure = sample->pressure;
   }
-
-  return true;
 }
 
 /*!
@@ -487,7 +570,8 @@ void Adafruit_DPS310_Temp::getSensor(sensor_t *sensor) {
 
 /**************************************************************************/
 /*!
-    @brief  Gets the temperature as a standard sensor event
+    @brief  Gets the temperature as a standard sensor event. Reads the bus,
+   see Adafruit_DPS310::setPublisher() for which task may call this.
     @param  event Sensor event object that will be populated
     @returns True
 */
@@ -519,7 +603,8 @@ void Adafruit_DPS310_Pressure::getSensor(sensor_t *sensor) {
 
 /**************************************************************************/
 /*!
-    @brief  Gets the pressure as a standard sensor event
+    @brief  Gets the pressure as a standard sensor event. Reads the bus,
+   see Adafruit_DPS310::setPublisher() for which task may call this.
     @param  event Sensor event object that will be populated
     @returns True
 */
@@ -527,3 +612,306 @@ void Adafruit_DPS310_Pressure::getSensor(sensor_t *sensor) {
 bool Adafruit_DPS310_Pressure::getEvent(sensors_event_t *event) {
   return _theDPS310->getEvents(NULL, event);
 }
+
+/**************************************************************************/
+/*!
+    @brief  Instantiates a publisher
+    @param  ring Caller owned storage for the sample history, or NULL to only
+   keep the latest sample
+    @param  ring_size Number of entries in ring. One is always kept free, so
+   up to ring_size - 1 samples are queued. Only the first 255 entries of a
+   larger ring are used.
+*/
+/**************************************************************************/
+Adafruit_DPS310_Publisher::Adafruit_DPS310_Publisher(dps310_sample_t *ring,
+                                                     size_t ring_size) {
+  _ring = ring;
+  if (ring == NULL) {
+    ring_size = 0;
+  }
+  // indices are uint8_t so they stay atomic on 8-bit parts
+  _ring_size = (ring_size > 255) ? 255 : ring_size;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Publish a sample as the latest one and queue it in the history
+   ring. Only one task (the producer) may call this, it never blocks. If the
+   ring is full the new sample is not queued, the consumer owns the oldest.
+    @param  sample The freshly compensated sample
+*/
+/**************************************************************************/
+void Adafruit_DPS310_Publisher::publish(const dps310_sample_t *sample) {
+  // Readers copy _latest[seq & 1], so write the other slot then flip
+  uint8_t seq = _latest_seq;
+  _latest[(seq + 1) & 1] = *sample;
+  __sync_synchronize();
+  _latest_seq = seq + 1;
+  // readers must not see the flag before the sequence it refers to
+  __sync_synchronize();
+  _latest_valid = true;
+
+  if (_ring_size < 2) {
+    return;
+  }
+  uint8_t head = _ring_head;
+  uint8_t next = (head + 1 == _ring_size) ? 0 : head + 1;
+  if (next == _ring_tail) {
+    return;
+  }
+  _ring[head] = *sample;
+  __sync_synchronize();
+  _ring_head = next;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Gets a consistent copy of the most recently published sample
+   without touching the bus. Safe to call from any number of tasks, cores or
+   an ISR. A reader that preempts the producer always succeeds, since the
+   producer only ever writes the slot readers aren't using.
+    @param  sample Pointer to a dps310_sample_t that will be filled in
+    @returns True on success, false if nothing has been published yet or the
+   producer (on another core) overwrote the slot on every retry
+*/
+/**************************************************************************/
+bool Adafruit_DPS310_Publisher::getLatestSample(dps310_sample_t *sample) {
+  if (!_latest_valid) {
+    return false;
+  }
+  __sync_synchronize();
+
+  for (uint8_t i = 0; i < latest_retries; i++) {
+    uint8_t seq = _latest_seq;
+    __sync_synchronize();
+    *sample = _latest[seq & 1];
+    __sync_synchronize();
+    if (seq == _latest_seq) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Removes the oldest sample from the history ring. Only one task
+   may consume from the ring.
+    @param  sample Pointer to a dps310_sample_t that will be filled in
+    @returns True if a sample was available, false if the ring was empty
+*/
+/**************************************************************************/
+bool Adafruit_DPS310_Publisher::popSample(dps310_sample_t *sample) {
+  uint8_t tail = _ring_tail;
+  if (tail == _ring_head) {
+    return false;
+  }
+  __sync_synchronize();
+  *sample = _ring[tail];
+  __sync_synchronize();
+  _ring_tail = (tail + 1 == _ring_size) ? 0 : tail + 1;
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  How many samples are waiting in the history ring
+    @returns Number of samples that popSample() can return
+*/
+/**************************************************************************/
+uint8_t Adafruit_DPS310_Publisher::samplesAvailable(void) {
+  uint8_t head = _ring_head, tail = _ring_tail;
+  return (head >= tail) ? head - tail : _ring_size - tail + head;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Push a value onto the back of a monotonic deque, dropping
+   candidates that have left the window or can never be the extreme again
+    @param  window The deque to update
+    @param  value The new sample
+    @param  seq The sample number of the new sample
+    @param  keep_max True to track the maximum, false for the minimum
+*/
+/**************************************************************************/
+void Adafruit_DPS310_Stats::_windowPush(_window_t *window, float value,
+                                        uint8_t seq, bool keep_max) {
+  while (window->count &&
+         (uint8_t)(seq - window->seq[window->head]) >= windowSize) {
+    window->head = (window->head + 1) % windowSize;
+    window->count--;
+  }
+
+  while (window->count) {
+    uint8_t back = (window->head + window->count - 1) % windowSize;
+    if (keep_max ? (window->value[back] > value)
+                 : (window->value[back] < value)) {
+      break;
+    }
+    window->count--;
+  }
+
+  uint8_t back = (window->head + window->count) % windowSize;
+  window->value[back] = value;
+  window->seq[back] = seq;
+  window->count++;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Instantiates an empty statistics channel
+*/
+/**************************************************************************/
+Adafruit_DPS310_Stats::Adafruit_DPS310_Stats(void) { reset(); }
+
+/**************************************************************************/
+/*!
+    @brief  Add a sample to the running and sliding window statistics, O(1)
+   amortized
+    @param  value The sample to add
+*/
+/**************************************************************************/
+void Adafruit_DPS310_Stats::add(float value) {
+  if (_count == 0) {
+    _min = _max = value;
+  } else {
+    if (value < _min)
+      _min = value;
+    if (value > _max)
+      _max = value;
+  }
+
+  // Welford's method, stable without keeping the samples around
+  _count++;
+  float delta = value - _mean;
+  _mean += delta / _count;
+  _m2 += delta * (value - _mean);
+
+  _windowPush(&_window_min, value, _seq, false);
+  _windowPush(&_window_max, value, _seq, true);
+  _seq++;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Copy out the current statistics and restart the interval. The
+   sliding window is kept, since it always covers the most recent samples.
+   Must be called from the task calling add(), Adafruit_DPS310_Aggregator
+   handles the cross-task case.
+    @param  stats Pointer to a dps310_stats_t that will be filled in. Fields
+   with no samples behind them are set to NAN.
+*/
+/**************************************************************************/
+void Adafruit_DPS310_Stats::snapshotAndReset(dps310_stats_t *stats) {
+  stats->count = _count;
+  if (_count) {
+    stats->min = _min;
+    stats->max = _max;
+    stats->mean = _mean;
+    stats->stddev = sqrt(_m2 / _count);
+  } else {
+    stats->min = stats->max = stats->mean = stats->stddev = NAN;
+  }
+
+  if (_window_min.count) {
+    stats->window_min = _window_min.value[_window_min.head];
+    stats->window_max = _window_max.value[_window_max.head];
+  } else {
+    stats->window_min = stats->window_max = NAN;
+  }
+
+  _count = 0;
+  _mean = _m2 = 0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Clear the interval statistics and the sliding window
+*/
+/**************************************************************************/
+void Adafruit_DPS310_Stats::reset(void) {
+  _count = 0;
+  _seq = 0;
+  _mean = _m2 = _min = _max = 0;
+  _window_min.head = _window_min.count = 0;
+  _window_max.head = _window_max.count = 0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Add a sample to the temperature and pressure statistics
+    @param  sample The sample to add
+*/
+/**************************************************************************/
+void Adafruit_DPS310_Aggregator::addSample(const dps310_sample_t *sample) {
+  _feeding = true;
+  __sync_synchronize();
+  if (_closing) {
+    // a snapshot is in progress, hold the sample back for the next interval
+    if (_deferred_count < DPS310_STATS_DEFERRED) {
+      _deferred[_deferred_count++] = *sample;
+    }
+    __sync_synchronize();
+    _feeding = false;
+    return;
+  }
+
+  for (uint8_t i = 0; i < _deferred_count; i++) {
+    _temperature.add(_deferred[i].temperature);
+    _pressure.add(_deferred[i].pressure);
+  }
+  _deferred_count = 0;
+  _temperature.add(sample->temperature);
+  _pressure.add(sample->pressure);
+
+  __sync_synchronize();
+  _feeding = false;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Copy out the statistics for both channels and restart the
+   interval. Safe to call from one task other than the one feeding samples,
+   and never blocks: if the feeding task is in the middle of addSample() it
+   returns false straight away and should be retried later. Samples that
+   arrive while the snapshot is taken count towards the next interval.
+    @param  temp_stats Filled in with temperature statistics in degrees C,
+   may be NULL
+    @param  pressure_stats Filled in with pressure statistics in hPa, may be
+   NULL
+    @returns True if the snapshot was taken, false if the feeding task was
+   busy and nothing was changed
+*/
+/**************************************************************************/
+bool Adafruit_DPS310_Aggregator::snapshotAndReset(
+    dps310_stats_t *temp_stats, dps310_stats_t *pressure_stats) {
+  // Each side raises its flag then checks the other's, so at most one of
+  // us touches the statistics at a time
+  _closing = true;
+  __sync_synchronize();
+  if (_feeding) {
+    __sync_synchronize();
+    _closing = false;
+    return false;
+  }
+
+  dps310_stats_t discard;
+  _temperature.snapshotAndReset(temp_stats ? temp_stats : &discard);
+  _pressure.snapshotAndReset(pressure_stats ? pressure_stats : &discard);
+
+  __sync_synchronize();
+  _closing = false;
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Clear all statistics, including the sliding windows. Only call
+   this while nothing is feeding samples, e.g. before setAggregator().
+*/
+/**************************************************************************/
+void Adafruit_DPS310_Aggregator::reset(void) {
+  _temperature.reset();
+  _pressure.reset();
+  _deferred_count = 0;
+}
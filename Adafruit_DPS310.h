@@ -69,6 +69,99 @@ typedef enum {
   DPS310_CONT_PRESTEMP = 0b111,   ///< Continuous temp+pressure measurements
 } dps310_mode_t;
 
+/** A compensated temperature + pressure measurement */
+typedef struct {
+  float temperature;  ///< Temperature in degrees C
+  float pressure;     ///< Pressure in hPa
+  uint32_t timestamp; ///< millis() when the sample was read
+} dps310_sample_t;
+
+/** Hands samples read by one task to other tasks or cores without a mutex.
+ * Attach with Adafruit_DPS310::setPublisher(). The caller owns the storage,
+ * so sketches that don't attach one don't pay for it. */
+class Adafruit_DPS310_Publisher {
+public:
+  explicit Adafruit_DPS310_Publisher(dps310_sample_t *ring = NULL,
+                                     size_t ring_size = 0);
+
+  void publish(const dps310_sample_t *sample);
+
+  bool getLatestSample(dps310_sample_t *sample);
+  bool popSample(dps310_sample_t *sample);
+  uint8_t samplesAvailable(void);
+
+private:
+  // Written only by the producer, read lock-free by consumers
+  dps310_sample_t _latest[2];
+  volatile uint8_t _latest_seq = 0;
+  volatile bool _latest_valid = false;
+
+  dps310_sample_t *_ring;
+  uint8_t _ring_size;
+  volatile uint8_t _ring_head = 0, _ring_tail = 0;
+};
+
+/** Summary statistics for one measurement channel */
+typedef struct {
+  uint32_t count;   ///< Samples accumulated since the last reset
+  float min;        ///< Smallest sample since the last reset
+  float max;        ///< Largest sample since the last reset
+  float mean;       ///< Mean of the samples since the last reset
+  float stddev;     ///< Population standard deviation since the last reset
+  float window_min; ///< Smallest of the last windowSize samples
+  float window_max; ///< Largest of the last windowSize samples
+} dps310_stats_t;
+
+/** Samples Adafruit_DPS310_Aggregator holds back while a snapshot is being
+ * taken from another task, any beyond this are dropped */
+#define DPS310_STATS_DEFERRED 4
+
+/** Constant memory running statistics for a single measurement channel */
+class Adafruit_DPS310_Stats {
+public:
+  /** Number of most recent samples covered by the sliding window min/max */
+  static const uint8_t windowSize = 16;
+
+  Adafruit_DPS310_Stats(void);
+
+  void add(float value);
+  void snapshotAndReset(dps310_stats_t *stats);
+  void reset(void);
+
+private:
+  // Fixed capacity monotonic deque for the sliding window min/max
+  typedef struct {
+    float value[windowSize]; // candidates, front is the extreme
+    uint8_t seq[windowSize]; // sample number, modulo 256
+    uint8_t head, count;
+  } _window_t;
+
+  static void _windowPush(_window_t *window, float value, uint8_t seq,
+                          bool keep_max);
+
+  uint32_t _count;
+  uint8_t _seq;
+  float _mean, _m2, _min, _max;
+  _window_t _window_min, _window_max;
+};
+
+/** Streaming temperature + pressure statistics, fed by Adafruit_DPS310 */
+class Adafruit_DPS310_Aggregator {
+public:
+  void addSample(const dps310_sample_t *sample);
+  bool snapshotAndReset(dps310_stats_t *temp_stats,
+                        dps310_stats_t *pressure_stats);
+  void reset(void);
+
+private:
+  Adafruit_DPS310_Stats _temperature, _pressure;
+
+  // Producer/consumer hand-off, see snapshotAndReset()
+  volatile bool _feeding = false, _closing = false;
+  dps310_sample_t _deferred[DPS310_STATS_DEFERRED];
+  uint8_t _deferred_count = 0;
+};
+
 class Adafruit_DPS310;
 
 /** Adafruit Unified Sensor interface for temperature component of DPS310 */
@@ -127,10 +220,18 @@ public:
 
   bool getEvents(sensors_event_t *temp_event, sensors_event_t *pressure_event);
 
+  void setPublisher(Adafruit_DPS310_Publisher *publisher);
+  bool getLatestEvents(sensors_event_t *temp_event,
+                       sensors_event_t *pressure_event);
+
+  void setAggregator(Adafruit_DPS310_Aggregator *aggregator);
+
 private:
   bool _init(void);
   void _readCalibration(void);
-  void _read();
+  dps310_sample_t _read(void);
+  void _fillEvents(const dps310_sample_t *sample, sensors_event_t *temp_event,
+                   sensors_event_t *pressure_event);
 
   int16_t _c0, _c1, _c01, _c11, _c20, _c21, _c30;
   int32_t _c00, _c10;
@@ -146,6 +247,9 @@ private:
   Adafruit_DPS310_Pressure *pressure_sensor = NULL;
 
   int32_t _sensorID;
+
+  Adafruit_DPS310_Publisher *_publisher = NULL;
+  Adafruit_DPS310_Aggregator *_aggregator = NULL;
 };
 
 #endif
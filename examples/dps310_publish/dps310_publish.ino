@@ -0,0 +1,81 @@
+// This example shows how one task reads the sensor while others get the
+// latest reading, or drain the history, without touching the bus
+
+#include <Adafruit_DPS310.h>
+
+Adafruit_DPS310 dps;
+
+// The publisher and its history ring are owned by the sketch
+dps310_sample_t history[16];
+Adafruit_DPS310_Publisher publisher(history,
+                                    sizeof(history) / sizeof(history[0]));
+
+uint32_t last_report = 0;
+
+// The one and only task that reads the bus once a publisher is attached
+void readSensor() {
+  if (dps.temperatureAvailable() && dps.pressureAvailable()) {
+    dps.getEvents(NULL, NULL);
+  }
+}
+
+#if defined(ESP32)
+void producerTask(void *) {
+  for (;;) {
+    readSensor();
+    delay(5);
+  }
+}
+#endif
+
+void setup() {
+  Serial.begin(115200);
+  while (!Serial)
+    delay(10);
+
+  Serial.println("DPS310");
+  if (!dps.begin_I2C()) {
+    Serial.println("Failed to find DPS");
+    while (1)
+      yield();
+  }
+  Serial.println("DPS OK!");
+
+  dps.configurePressure(DPS310_8HZ, DPS310_16SAMPLES);
+  dps.configureTemperature(DPS310_8HZ, DPS310_16SAMPLES);
+  dps.setPublisher(&publisher);
+
+#if defined(ESP32)
+  // read the sensor from its own task, loop() is just a consumer
+  xTaskCreatePinnedToCore(producerTask, "dps310", 4096, NULL, 1, NULL, 0);
+#endif
+}
+
+void loop() {
+#if !defined(ESP32)
+  // no RTOS here, so loop() is both producer and consumer
+  readSensor();
+#endif
+
+  if (millis() - last_report < 1000) {
+    return;
+  }
+  last_report = millis();
+
+  dps310_sample_t sample;
+  if (publisher.getLatestSample(&sample)) {
+    Serial.print(F("Latest: "));
+    Serial.print(sample.temperature);
+    Serial.print(" *C, ");
+    Serial.print(sample.pressure);
+    Serial.println(" hPa");
+  }
+
+  uint8_t count = 0;
+  while (publisher.popSample(&sample)) {
+    count++;
+  }
+  Serial.print(F("Samples since last report: "));
+  Serial.println(count);
+  Serial.println();
+}
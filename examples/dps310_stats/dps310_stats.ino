@@ -0,0 +1,66 @@
+// This example keeps running min/max/mean/stddev of temperature and
+// pressure inside the driver and prints a summary every few seconds
+
+#include <Adafruit_DPS310.h>
+
+Adafruit_DPS310 dps;
+Adafruit_DPS310_Aggregator stats;
+
+uint32_t last_report = 0;
+
+void printStats(const char *name, dps310_stats_t *s) {
+  Serial.print(name);
+  Serial.print(F(": n="));
+  Serial.print(s->count);
+  Serial.print(F(" min="));
+  Serial.print(s->min);
+  Serial.print(F(" max="));
+  Serial.print(s->max);
+  Serial.print(F(" mean="));
+  Serial.print(s->mean);
+  Serial.print(F(" stddev="));
+  Serial.print(s->stddev, 4);
+  Serial.print(F(" window min/max="));
+  Serial.print(s->window_min);
+  Serial.print("/");
+  Serial.println(s->window_max);
+}
+
+void setup() {
+  Serial.begin(115200);
+  while (!Serial)
+    delay(10);
+
+  Serial.println("DPS310");
+  if (!dps.begin_I2C()) {
+    Serial.println("Failed to find DPS");
+    while (1)
+      yield();
+  }
+  Serial.println("DPS OK!");
+
+  dps.configurePressure(DPS310_16HZ, DPS310_16SAMPLES);
+  dps.configureTemperature(DPS310_16HZ, DPS310_16SAMPLES);
+  // every sample read from now on is added to the statistics
+  dps.setAggregator(&stats);
+}
+
+void loop() {
+  if (dps.temperatureAvailable() && dps.pressureAvailable()) {
+    dps.getEvents(NULL, NULL);
+  }
+
+  if (millis() - last_report < 5000) {
+    return;
+  }
+
+  dps310_stats_t temp_stats, pressure_stats;
+  if (!stats.snapshotAndReset(&temp_stats, &pressure_stats)) {
+    return; // only happens when samples are fed from another task
+  }
+  last_report = millis();
+
+  printStats("Temperature (*C)", &temp_stats);
+  printStats("Pressure (hPa)", &pressure_stats);
+  Serial.println();
+}